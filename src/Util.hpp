@@ -2,6 +2,8 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <cstdio>
+#include <cerrno>
 
 uint8_t from_hex(char c) {
     if(c >= '0' && c <= '9')
@@ -33,4 +35,31 @@ bool from_hex(std::string s, std::vector<uint8_t>& out) {
         }
     }
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * Name of a temporary file next to name, attempt makes it unique
+*/
+std::string temp_name(const std::string& name, unsigned attempt) {
+    std::string result = name + ".tmp";
+    if(attempt) result += std::to_string(attempt);
+    return result;
+}
+
+/**
+ * Creates a new empty file next to name, an existing file is never overwritten
+ * @return returns name of the created file or empty string on failure
+*/
+std::string create_temp_file(const std::string& name) {
+    for(unsigned attempt = 0; attempt < 100; attempt++) {
+        std::string tmp = temp_name(name, attempt);
+        //x fails if the file exists
+        std::FILE* f = std::fopen(tmp.c_str(), "wbx");
+        if(f != nullptr) {
+            std::fclose(f);
+            return tmp;
+        }
+        if(errno != EEXIST) return "";
+    }
+    return "";
+}
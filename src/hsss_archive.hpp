@@ -0,0 +1,300 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <algorithm>
+#include <set>
+#include "hsss_lib.hpp"
+#include "Util.hpp"
+
+/**
+ * Packed archive format, everything after the salt is one encrypted stream:
+ *
+ * ``[ salt ][ member count ][ index entries ][ member data ]``
+ *
+ * Index entry is ``[ name length (u32) ][ name ][ offset (u64) ][ size (u64) ]``,
+ * integers are little endian. Offset is the position of member data in the stream
+ * (not counting the salt), so a member can be decrypted on its own.
+ *
+ * The index is mostly known plaintext, so the stream uses a keystream that never repeats,
+ * see Keystream.
+*/
+namespace hsss::archive {
+
+    const std::size_t chunk_size = 1 << 16;
+    //longer names mean wrong password or damaged archive
+    const std::size_t max_name_size = 4096;
+
+    struct Entry {
+        std::string name;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    /**
+     * Keystream of the archive. The hash input is the block counter, the shifted password and the salt,
+     * where a block is one full rotation of the password. Unlike hsss::keystream it never repeats,
+     * so known plaintext at one position says nothing about others. Any position can still be computed directly.
+    */
+    class Keystream {
+    public:
+        Keystream() = default;
+
+        template<typename Iter>
+        Keystream(const std::string& password, Iter salt_begin, Iter salt_end) :
+            _password(password), _salt(salt_begin, salt_end) {}
+
+        /**
+         * Encrypts (or decrypts) data in place, pos is the position of begin in the stream
+        */
+        template<typename Iter>
+        void apply(Iter begin, Iter end, uint64_t pos, bool encrypt) const {
+            std::size_t period = _password.size() ? _password.size() : 1;
+            uint64_t block = pos / period;
+            std::size_t shift = pos % period;
+            uint8_t counter_state = counter_hash(block);
+
+            for(auto it = begin; it != end; ++it) {
+                uint8_t current = counter_state;
+                for(std::size_t i = 0; i < _password.size(); i++) {
+                    current = compress(current, _password[(shift + i) % _password.size()]);
+                }
+                for(auto s : _salt) {
+                    current = compress(current, s);
+                }
+
+                uint8_t b = static_cast<uint8_t>(*it);
+                *it = encrypt ? b + current : b - current;
+
+                if(++shift == period) {
+                    shift = 0;
+                    counter_state = counter_hash(++block);
+                }
+            }
+        }
+
+    private:
+        //the counter goes first, so no state depending only on the password is ever reused
+        static uint8_t counter_hash(uint64_t block) {
+            //implementation defined seed, same as in hash
+            uint8_t current = 0xff;
+            for(std::size_t i = 0; i < sizeof(block); i++) {
+                current = compress(current, static_cast<uint8_t>(block >> (8 * i)));
+            }
+            return current;
+        }
+
+        std::string _password;
+        std::vector<uint8_t> _salt;
+    };
+
+    template<typename T>
+    void put_int(std::vector<uint8_t>& out, T n) {
+        for(std::size_t i = 0; i < sizeof(T); i++) {
+            out.push_back(static_cast<uint8_t>(n >> (8 * i)));
+        }
+    }
+
+    template<typename T>
+    bool get_int(const std::vector<uint8_t>& in, std::size_t& pos, T& n) {
+        if(in.size() - pos < sizeof(T)) return false;
+        n = 0;
+        for(std::size_t i = 0; i < sizeof(T); i++) {
+            n |= static_cast<T>(in[pos++]) << (8 * i);
+        }
+        return true;
+    }
+
+    /**
+     * Reads and decrypts count bytes starting at stream position pos
+    */
+    bool read_at(std::istream& file, const Keystream& ks, uint64_t pos, std::size_t count, std::vector<uint8_t>& out) {
+        out.resize(count);
+        file.seekg(salt_size + pos);
+        file.read(reinterpret_cast<char*>(out.data()), count);
+        if(static_cast<std::size_t>(file.gcount()) != count) return false;
+        ks.apply(out.begin(), out.end(), pos, false);
+        return true;
+    }
+
+    /**
+     * Turns a path into a member name: normalized, without root and at most max_name_size long.
+     * @return returns empty string if the path points outside of current directory
+    */
+    std::string member_name(const std::filesystem::path& filename) {
+        auto name = filename.lexically_normal().relative_path();
+        if(name.empty() || std::find(name.begin(), name.end(), "..") != name.end()) return "";
+
+        std::string result = name.string();
+        if(result.size() > max_name_size) return "";
+        return result;
+    }
+
+    /**
+     * Member names are stored the way member_name makes them, anything else is refused on unpacking
+    */
+    inline bool valid_member_name(const std::string& name) {
+        return !name.empty() && member_name(name) == name;
+    }
+
+    /**
+     * Packs files into one archive, with one salt and one keystream for all of them.
+     * The archive is written to a temporary file first, so an existing one is left intact on failure.
+     * Returns false if any of the files could not be read or packed.
+    */
+    bool pack(const std::vector<char*>& filenames, std::string password, const std::string& archive_name) {
+        std::vector<Entry> entries;
+        std::set<std::string> names;
+        uint64_t index_size = sizeof(uint64_t);
+        for(auto filename : filenames) {
+            std::error_code ec;
+            Entry e;
+            e.size = std::filesystem::file_size(filename, ec);
+            if(ec) {
+                std::cout << "Error! file " << filename << " cannot be opened for reading!\n";
+                return false;
+            }
+            e.name = member_name(filename);
+            if(e.name.empty()) {
+                std::cout << "Error! file " << filename << " cannot be packed, it is outside of current directory or its name is too long!\n";
+                return false;
+            }
+            if(!names.insert(e.name).second) {
+                std::cout << "Error! file " << filename << " is already packed as " << e.name << "!\n";
+                return false;
+            }
+            index_size += sizeof(uint32_t) + e.name.size() + 2 * sizeof(uint64_t);
+            entries.push_back(e);
+        }
+
+        std::string tmp_name = create_temp_file(archive_name);
+        if(tmp_name.empty()) {
+            std::cout << "Error! temporary file for " << archive_name << " could not be created!\n";
+            return false;
+        }
+        std::ofstream ofile(tmp_name, std::ios::out | std::ios::binary);
+        if(!ofile) {
+            std::cout << "Error! file " << tmp_name << " could not be opened or created for write!\n";
+            std::remove(tmp_name.c_str());
+            return false;
+        }
+
+        auto fail = [&]() {
+            ofile.close();
+            std::remove(tmp_name.c_str());
+            return false;
+        };
+
+        std::vector<uint8_t> salt(salt_size);
+        generate_salt(salt.begin(), salt.end());
+        Keystream ks(password, salt.begin(), salt.end());
+
+        std::vector<uint8_t> index;
+        index.reserve(index_size);
+        put_int<uint64_t>(index, entries.size());
+        uint64_t offset = index_size;
+        for(auto& e : entries) {
+            e.offset = offset;
+            offset += e.size;
+            put_int<uint32_t>(index, e.name.size());
+            index.insert(index.end(), e.name.begin(), e.name.end());
+            put_int<uint64_t>(index, e.offset);
+            put_int<uint64_t>(index, e.size);
+        }
+
+        ks.apply(index.begin(), index.end(), 0, true);
+        ofile.write(reinterpret_cast<const char*>(salt.data()), salt.size());
+        ofile.write(reinterpret_cast<const char*>(index.data()), index.size());
+
+        std::vector<uint8_t> buf(chunk_size);
+        for(std::size_t i = 0; i < entries.size(); i++) {
+            std::ifstream file(filenames[i], std::ios::in | std::ios::binary);
+            uint64_t left = entries[i].size;
+            uint64_t pos = entries[i].offset;
+            while(file && left) {
+                std::size_t count = std::min<uint64_t>(left, chunk_size);
+                file.read(reinterpret_cast<char*>(buf.data()), count);
+                if(static_cast<std::size_t>(file.gcount()) != count) break;
+
+                ks.apply(buf.begin(), buf.begin() + count, pos, true);
+                ofile.write(reinterpret_cast<const char*>(buf.data()), count);
+                left -= count;
+                pos += count;
+            }
+            if(left) {
+                std::cout << "Error! file " << filenames[i] << " changed or could not be read while packing!\n";
+                return fail();
+            }
+        }
+
+        ofile.close();
+        if(!ofile) {
+            std::cout << "Error! file " << tmp_name << " could not be written!\n";
+            return fail();
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_name, archive_name, ec);
+        if(ec) {
+            std::cout << "Error! file " << tmp_name << " could not be renamed to " << archive_name << "!\n";
+            return fail();
+        }
+        return true;
+    }
+
+    /**
+     * Reads the index of an archive and the keystream needed for extracting its members
+    */
+    bool read_index(std::istream& file, std::string password, Keystream& ks, std::vector<Entry>& entries) {
+        std::vector<uint8_t> salt(salt_size);
+        file.read(reinterpret_cast<char*>(salt.data()), salt.size());
+        if(static_cast<std::size_t>(file.gcount()) != salt_size) return false;
+        ks = Keystream(password, salt.begin(), salt.end());
+
+        std::vector<uint8_t> buf;
+        std::size_t pos = 0;
+        uint64_t count;
+        if(!read_at(file, ks, 0, sizeof(count), buf) || !get_int(buf, pos, count)) return false;
+
+        uint64_t stream_pos = sizeof(count);
+        for(uint64_t i = 0; i < count; i++) {
+            Entry e;
+            uint32_t name_size;
+            pos = 0;
+            if(!read_at(file, ks, stream_pos, sizeof(name_size), buf) || !get_int(buf, pos, name_size)) return false;
+            stream_pos += sizeof(name_size);
+            if(name_size > max_name_size) return false;
+
+            if(!read_at(file, ks, stream_pos, name_size + 2 * sizeof(uint64_t), buf)) return false;
+            stream_pos += buf.size();
+            e.name.assign(buf.begin(), buf.begin() + name_size);
+            pos = name_size;
+            get_int(buf, pos, e.offset);
+            get_int(buf, pos, e.size);
+
+            entries.push_back(e);
+        }
+        return true;
+    }
+
+    /**
+     * Decrypts a single member, seeking straight to its offset
+    */
+    bool extract(std::istream& file, const Keystream& ks, const Entry& e, std::ostream& ofile) {
+        std::vector<uint8_t> buf;
+        uint64_t left = e.size;
+        uint64_t pos = e.offset;
+        while(left) {
+            std::size_t count = std::min<uint64_t>(left, chunk_size);
+            if(!read_at(file, ks, pos, count, buf)) return false;
+
+            ofile.write(reinterpret_cast<const char*>(buf.data()), count);
+            left -= count;
+            pos += count;
+        }
+        return static_cast<bool>(ofile);
+    }
+};
@@ -6,6 +6,9 @@
 
 namespace hsss {
 
+    //salt sits at the beginning of encrypted data
+    const std::size_t salt_size = 16;
+
     /**
      * Calculates polynomial of x where the bits of a are coefficients and adds a and b
     */
@@ -52,7 +55,6 @@ namespace hsss {
 
     template<typename Iter>
     std::vector<uint8_t> encrypt(Iter begin, Iter end, std::string password) {
-        const std::size_t salt_size = 16;
         std::vector<uint8_t> result(salt_size);
         
         generate_salt(result.begin(), result.end());
@@ -79,10 +81,9 @@ namespace hsss {
 
     template<typename Iter>
     std::vector<uint8_t> decrypt(Iter begin, Iter end, std::string password) {
-        const std::size_t salt_size = 16;
         std::vector<uint8_t> result;
         std::size_t data_size = end - begin;
-        if(data_size <= 16) return std::vector<uint8_t>(3,'x');
+        if(data_size <= salt_size) return std::vector<uint8_t>(3,'x');
         result.reserve(data_size - salt_size);
         
         password.reserve(password.size() + salt_size);
@@ -104,6 +105,46 @@ namespace hsss {
         return result;
     }
 
+    /**
+     * Shifting the password makes the hash cycle with the period of the password length,
+     * so the whole keystream is described by one period of it.
+     * Byte at position i of the data is offset by keystream[i % keystream.size()]
+    */
+    template<typename Iter>
+    std::vector<uint8_t> keystream(std::string password, Iter salt_begin, Iter salt_end) {
+        std::size_t period = password.size() ? password.size() : 1;
+        std::vector<uint8_t> result;
+        result.reserve(period);
+
+        std::size_t password_size = password.size();
+        //copy salt at the end of the password
+        password.insert(password.end(), salt_begin, salt_end);
+
+        auto pbegin = password.begin();
+        auto pend = pbegin + password_size;
+
+        for(std::size_t i = 0; i < period; i++) {
+            result.push_back(hash(password.begin(), password.end()));
+            if(pbegin != pend)
+                std::rotate(pbegin, pbegin + 1, pend);
+        }
+
+        return result;
+    }
+
+    /**
+     * Encrypts (or decrypts) data in place, pos is the position of begin in the whole stream
+    */
+    template<typename Iter>
+    void apply_keystream(Iter begin, Iter end, const std::vector<uint8_t>& ks, uint64_t pos, bool encrypt) {
+        std::size_t k = pos % ks.size();
+        for(auto it = begin; it != end; ++it) {
+            uint8_t b = static_cast<uint8_t>(*it);
+            *it = encrypt ? b + ks[k] : b - ks[k];
+            if(++k == ks.size()) k = 0;
+        }
+    }
+
     void encrypt_stream(std::istream& file, std::string password, std::ostream& ofile) {
         auto in_begin = std::istreambuf_iterator<char>(file);
         auto in_end = std::istreambuf_iterator<char>();
@@ -0,0 +1,712 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <initializer_list>
+#include <iostream>
+#include <cstdio>
+#include "hsss_lib.hpp"
+#include "Util.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HSSS_IO_URING 1
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+/**
+ * Batched file processing on top of Linux io_uring.
+ * Opens, reads, writes and closes of many files are kept in flight together,
+ * data goes through a fixed pool of chunk buffers and each chunk is encrypted as soon as it is read.
+ * Ring::init fails on other systems or when the kernel lacks io_uring or any of the operations used,
+ * the caller should then fall back to iostreams.
+*/
+namespace hsss::uring {
+
+#ifdef HSSS_IO_URING
+
+    /**
+     * Minimal io_uring wrapper using raw syscalls, so liburing is not needed
+    */
+    class Ring {
+    public:
+        Ring() = default;
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+        ~Ring() {
+            if(_sqes != nullptr) munmap(_sqes, _sqes_size);
+            if(_cq_ptr != nullptr && _cq_ptr != _sq_ptr) munmap(_cq_ptr, _cq_size);
+            if(_sq_ptr != nullptr) munmap(_sq_ptr, _sq_size);
+            if(_fd >= 0) close(_fd);
+        }
+
+        /**
+         * @return returns true on success, false if io_uring or any of the needed operations is not available
+        */
+        bool init(unsigned entries) {
+            io_uring_params p{};
+            _fd = syscall(__NR_io_uring_setup, entries, &p);
+            if(_fd < 0) return false;
+
+            _sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            _cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+            if(single_mmap) {
+                _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+            }
+
+            _sq_ptr = map(_sq_size, IORING_OFF_SQ_RING);
+            if(_sq_ptr == nullptr) return false;
+            _cq_ptr = single_mmap ? _sq_ptr : map(_cq_size, IORING_OFF_CQ_RING);
+            if(_cq_ptr == nullptr) return false;
+            _sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+            _sqes = static_cast<io_uring_sqe*>(map(_sqes_size, IORING_OFF_SQES));
+            if(_sqes == nullptr) return false;
+
+            auto sq = static_cast<char*>(_sq_ptr);
+            _sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+            _sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+            _sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+            _sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+            auto cq = static_cast<char*>(_cq_ptr);
+            _cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+            _cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+            _cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+            _cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+            _entries = p.sq_entries;
+            //kernels before 5.6 set up the ring but lack openat, statx and close
+            return supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE});
+        }
+
+        inline unsigned entries() const {
+            return _entries;
+        }
+
+        /**
+         * @return returns zeroed submission entry or nullptr when the queue is full
+        */
+        io_uring_sqe* get_sqe() {
+            unsigned head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+            if(_local_tail - head >= _entries) return nullptr;
+
+            unsigned index = _local_tail & _sq_mask;
+            _sq_array[index] = index;
+            _local_tail++;
+            _queued++;
+
+            io_uring_sqe* sqe = &_sqes[index];
+            *sqe = io_uring_sqe{};
+            return sqe;
+        }
+
+        /**
+         * Submits queued entries and waits for at least wait_nr completions
+         * @return returns 0 on success or negative errno
+        */
+        int submit(unsigned wait_nr) {
+            __atomic_store_n(_sq_tail, _local_tail, __ATOMIC_RELEASE);
+            unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+            while(true) {
+                long ret = syscall(__NR_io_uring_enter, _fd, _queued, wait_nr, flags, nullptr, 0);
+                if(ret >= 0) {
+                    _queued -= std::min<unsigned>(ret, _queued);
+                    return 0;
+                }
+                if(errno != EINTR) return -errno;
+            }
+        }
+
+        /**
+         * @return returns oldest completion or nullptr if there are none, call cqe_seen after handling it
+        */
+        io_uring_cqe* peek_cqe() {
+            unsigned head = *_cq_head;
+            if(head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) return nullptr;
+            return &_cqes[head & _cq_mask];
+        }
+
+        void cqe_seen() {
+            __atomic_store_n(_cq_head, *_cq_head + 1, __ATOMIC_RELEASE);
+        }
+
+    private:
+        bool supports(std::initializer_list<unsigned> ops) {
+            const unsigned max_ops = 256;
+            //uint64_t keeps the probe aligned
+            std::vector<uint64_t> mem((sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op)) / sizeof(uint64_t) + 1);
+            auto probe = reinterpret_cast<io_uring_probe*>(mem.data());
+            if(syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PROBE, probe, max_ops) < 0) return false;
+
+            for(auto op : ops) {
+                if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+            }
+            return true;
+        }
+
+        void* map(std::size_t size, off_t offset) {
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, offset);
+            return ptr == MAP_FAILED ? nullptr : ptr;
+        }
+
+        int _fd = -1;
+        unsigned _entries = 0;
+
+        void* _sq_ptr = nullptr;
+        void* _cq_ptr = nullptr;
+        io_uring_sqe* _sqes = nullptr;
+        std::size_t _sq_size = 0;
+        std::size_t _cq_size = 0;
+        std::size_t _sqes_size = 0;
+
+        unsigned* _sq_head = nullptr;
+        unsigned* _sq_tail = nullptr;
+        unsigned* _sq_array = nullptr;
+        unsigned _sq_mask = 0;
+        unsigned _local_tail = 0;
+        unsigned _queued = 0;
+
+        unsigned* _cq_head = nullptr;
+        unsigned* _cq_tail = nullptr;
+        unsigned _cq_mask = 0;
+        io_uring_cqe* _cqes = nullptr;
+    };
+
+    const unsigned queue_depth = 128;
+    //files open at once
+    const std::size_t max_jobs = 32;
+    //chunk buffers shared by all files, they bound memory used for data
+    const std::size_t max_buffers = 64;
+    const std::size_t chunk_size = 1 << 16;
+    //attempts at finding a free temporary file name
+    const unsigned max_temp_attempts = 100;
+
+    enum class OpType : uint8_t {
+        open_in,
+        statx,
+        read_head,
+        open_out,
+        write_head,
+        read,
+        write,
+        close_in,
+        close_out
+    };
+
+    struct Op {
+        uint32_t job;
+        OpType type;
+        //chunk buffer for reads and writes, file descriptor for closes
+        uint32_t arg = 0;
+    };
+
+    struct Job {
+        std::string in_name;
+        std::string out_name;
+        //output is written to a temporary file and renamed on success
+        std::string write_name;
+        unsigned temp_attempt = 0;
+        bool temp_created = false;
+        int in_fd = -1;
+        int out_fd = -1;
+        struct statx stx{};
+
+        //salt, or whole output of data too short to be encrypted
+        std::vector<uint8_t> head;
+        std::size_t head_done = 0;
+        std::vector<uint8_t> ks;
+
+        //data starts after the salt in the encrypted file
+        uint64_t in_base = 0;
+        uint64_t out_base = 0;
+
+        //statx size is only a hint, reads go on until one of them hits the end of file
+        uint64_t next_chunk = 0;
+        uint64_t read_limit = 0;
+        uint64_t eof_pos = 0;
+        uint64_t data_read = 0;
+        uint64_t total_read = 0;
+        unsigned reads_out = 0;
+        unsigned writes_out = 0;
+
+        //ops of the current stage for opens, statx, head read and close_out
+        std::size_t pending = 0;
+        bool eof = false;
+        bool read_finished = false;
+        bool queued = false;
+        bool started = false;
+        bool done = false;
+        bool changed = false;
+        bool failed = false;
+    };
+
+    struct Slot {
+        std::vector<uint8_t> buf;
+        uint64_t chunk = 0;
+        std::size_t len = 0;
+        std::size_t done = 0;
+    };
+
+    /**
+     * Buffers used by process_files. The caller keeps them alive longer than the ring,
+     * as the kernel may still use them if the ring could not be drained.
+    */
+    struct Batch {
+        std::vector<Job> jobs;
+        std::vector<Slot> slots;
+    };
+
+    /**
+     * Encrypts or decrypts files, files[i] is written to out_names[i].
+     * Removes processed files if remove is set.
+     * @return returns false if the ring itself failed, errors of single files are only reported
+    */
+    bool process_files(Ring& ring, Batch& batch, const std::vector<std::string>& files, const std::vector<std::string>& out_names,
+                       const std::string& password, bool encrypt, bool remove) {
+        auto& jobs = batch.jobs;
+        auto& slots = batch.slots;
+        jobs.assign(files.size(), Job());
+        slots.assign(max_buffers, Slot());
+        std::vector<uint32_t> free_slots;
+        for(uint32_t i = 0; i < max_buffers; i++) {
+            free_slots.push_back(i);
+        }
+
+        std::deque<Op> backlog;
+        //files waiting for a chunk buffer
+        std::deque<uint32_t> streaming;
+        std::size_t next_job = 0;
+        std::size_t active = 0;
+        unsigned in_flight = 0;
+        bool draining = false;
+
+        auto close_fd = [&](uint32_t j, int& fd, OpType type) {
+            if(fd < 0) return;
+            backlog.push_back({j, type, static_cast<uint32_t>(fd)});
+            fd = -1;
+        };
+
+        auto finish = [&](uint32_t j) {
+            Job& job = jobs[j];
+            close_fd(j, job.in_fd, OpType::close_in);
+            close_fd(j, job.out_fd, OpType::close_out);
+            job.head = std::vector<uint8_t>();
+            job.ks = std::vector<uint8_t>();
+            job.done = true;
+            active--;
+        };
+
+        auto start = [&](uint32_t j) {
+            Job& job = jobs[j];
+            job.in_name = files[j];
+            job.out_name = out_names[j];
+            job.started = true;
+            job.pending = 2;
+            backlog.push_back({j, OpType::open_in});
+            backlog.push_back({j, OpType::statx});
+            active++;
+        };
+
+        auto enqueue = [&](uint32_t j) {
+            Job& job = jobs[j];
+            if(job.queued || job.eof || job.failed || job.next_chunk >= job.read_limit) return;
+            job.queued = true;
+            streaming.push_back(j);
+        };
+
+        auto open_output = [&](uint32_t j) {
+            Job& job = jobs[j];
+            job.write_name = temp_name(job.out_name, job.temp_attempt);
+            job.pending = 1;
+            backlog.push_back({j, OpType::open_out});
+        };
+
+        auto check_done = [&](uint32_t j) {
+            Job& job = jobs[j];
+            if(!job.read_finished && (job.eof || job.failed) && job.reads_out == 0) {
+                job.read_finished = true;
+                close_fd(j, job.in_fd, OpType::close_in);
+
+                //reads must have met at the end of file, at the size statx gave unless it said nothing
+                if(!job.failed && (job.data_read != job.eof_pos || (job.stx.stx_size && job.total_read != job.stx.stx_size))) {
+                    job.changed = true;
+                    job.failed = true;
+                }
+                if(!job.failed && !encrypt && job.data_read == 0) {
+                    //let the library handle data too short to be encrypted
+                    job.head = hsss::decrypt(job.head.begin(), job.head.end(), password);
+                    job.head_done = 0;
+                    job.writes_out++;
+                    backlog.push_back({j, OpType::write_head});
+                }
+            }
+            if(job.read_finished && job.writes_out == 0 && job.out_fd >= 0) {
+                job.pending = 1;
+                close_fd(j, job.out_fd, OpType::close_out);
+            }
+        };
+
+        auto prepare = [&](io_uring_sqe* sqe, const Op& op) {
+            Job& job = jobs[op.job];
+            sqe->user_data = (static_cast<uint64_t>(op.job) << 40) | (static_cast<uint64_t>(op.type) << 32) | op.arg;
+
+            switch(op.type) {
+            case OpType::open_in:
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(job.in_name.c_str());
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                break;
+            case OpType::statx:
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(job.in_name.c_str());
+                sqe->len = STATX_TYPE | STATX_SIZE;
+                sqe->off = reinterpret_cast<uint64_t>(&job.stx);
+                break;
+            case OpType::open_out:
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(job.write_name.c_str());
+                //never overwrite a file that happens to have the temporary name
+                sqe->open_flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+                //same as std::ofstream, umask applies
+                sqe->len = 0666;
+                break;
+            case OpType::read_head:
+            case OpType::write_head:
+                sqe->opcode = (op.type == OpType::read_head) ? IORING_OP_READ : IORING_OP_WRITE;
+                sqe->fd = (op.type == OpType::read_head) ? job.in_fd : job.out_fd;
+                sqe->addr = reinterpret_cast<uint64_t>(job.head.data() + job.head_done);
+                sqe->len = job.head.size() - job.head_done;
+                sqe->off = job.head_done;
+                break;
+            case OpType::read:
+            case OpType::write: {
+                Slot& slot = slots[op.arg];
+                uint64_t base = (op.type == OpType::read) ? job.in_base : job.out_base;
+                sqe->opcode = (op.type == OpType::read) ? IORING_OP_READ : IORING_OP_WRITE;
+                sqe->fd = (op.type == OpType::read) ? job.in_fd : job.out_fd;
+                sqe->addr = reinterpret_cast<uint64_t>(slot.buf.data() + slot.done);
+                sqe->len = slot.len - slot.done;
+                sqe->off = base + slot.chunk * chunk_size + slot.done;
+                break;
+            }
+            case OpType::close_in:
+            case OpType::close_out:
+                sqe->opcode = IORING_OP_CLOSE;
+                sqe->fd = static_cast<int>(op.arg);
+                break;
+            }
+        };
+
+        //called once every operation of the current stage has completed
+        auto advance = [&](uint32_t j, OpType stage) {
+            Job& job = jobs[j];
+            switch(stage) {
+            case OpType::open_in:
+            case OpType::statx:
+                if(job.failed) {
+                    std::cout << "Error! file " << job.in_name << " cannot be opened for reading!\n";
+                    finish(j);
+                    return;
+                }
+                if(!S_ISREG(job.stx.stx_mode)) {
+                    std::cout << "Error! file " << job.in_name << " is not a regular file!\n";
+                    finish(j);
+                    return;
+                }
+                if(encrypt) {
+                    job.head.resize(salt_size);
+                    generate_salt(job.head.begin(), job.head.end());
+                    job.ks = keystream(password, job.head.begin(), job.head.end());
+                    job.out_base = salt_size;
+                    open_output(j);
+                    return;
+                }
+                job.head.resize(salt_size);
+                job.pending = 1;
+                backlog.push_back({j, OpType::read_head});
+                return;
+            case OpType::read_head:
+                if(job.failed) {
+                    std::cout << "Error! file " << job.in_name << " could not be read!\n";
+                    finish(j);
+                    return;
+                }
+                if(!job.eof) {
+                    job.ks = keystream(password, job.head.begin(), job.head.end());
+                    job.in_base = salt_size;
+                }
+                open_output(j);
+                return;
+            case OpType::open_out: {
+                if(job.failed) {
+                    std::cout << "Error! file " << job.write_name << " could not be opened or created for write!\n";
+                    finish(j);
+                    return;
+                }
+                if(encrypt) {
+                    job.head_done = 0;
+                    job.writes_out++;
+                    backlog.push_back({j, OpType::write_head});
+                }
+                //one chunk more than statx says, to find the end of file
+                uint64_t expected = job.stx.stx_size > job.in_base ? job.stx.stx_size - job.in_base : 0;
+                job.read_limit = (expected + chunk_size - 1) / chunk_size + 1;
+                enqueue(j);
+                check_done(j);
+                return;
+            }
+            case OpType::close_out:
+                if(job.failed) {
+                    if(job.changed)
+                        std::cout << "Error! file " << job.in_name << " changed while being read!\n";
+                    else
+                        std::cout << "Error! file " << job.in_name << " could not be read or " << job.write_name << " could not be written!\n";
+                    std::remove(job.write_name.c_str());
+                    finish(j);
+                    return;
+                }
+                if(std::rename(job.write_name.c_str(), job.out_name.c_str()) != 0) {
+                    std::cout << "Error! file " << job.write_name << " could not be renamed to " << job.out_name << "!\n";
+                    std::remove(job.write_name.c_str());
+                    finish(j);
+                    return;
+                }
+                if(remove && job.in_name != job.out_name) {
+                    std::remove(job.in_name.c_str());
+                }
+                std::cout << "File " << job.in_name << " successfully " << (encrypt ? "encrypted" : "decrypted") << " to " << job.out_name << '\n';
+                finish(j);
+                return;
+            default:
+                return;
+            }
+        };
+
+        auto complete = [&](uint64_t user_data, int res) {
+            uint32_t j = user_data >> 40;
+            OpType type = static_cast<OpType>((user_data >> 32) & 0xff);
+            uint32_t arg = user_data & 0xffffffff;
+            Job& job = jobs[j];
+
+            switch(type) {
+            case OpType::close_in:
+                return;
+            case OpType::open_in:
+                if(res >= 0) job.in_fd = res;
+                break;
+            case OpType::open_out:
+                if(res == -EEXIST && ++job.temp_attempt < max_temp_attempts) {
+                    job.write_name = temp_name(job.out_name, job.temp_attempt);
+                    backlog.push_back({j, type});
+                    return;
+                }
+                if(res >= 0) {
+                    job.out_fd = res;
+                    job.temp_created = true;
+                }
+                break;
+            case OpType::read_head:
+                if(res > 0) {
+                    job.head_done += res;
+                    job.total_read += res;
+                    if(job.head_done < job.head.size()) {
+                        backlog.push_back({j, type});
+                        return;
+                    }
+                }
+                else if(res == 0) {
+                    //shorter than the salt
+                    job.head.resize(job.head_done);
+                    job.eof = true;
+                }
+                break;
+            case OpType::write_head:
+                if(res > 0) {
+                    job.head_done += res;
+                    if(job.head_done < job.head.size()) {
+                        backlog.push_back({j, type});
+                        return;
+                    }
+                }
+                else {
+                    job.failed = true;
+                }
+                job.writes_out--;
+                check_done(j);
+                return;
+            case OpType::read: {
+                Slot& slot = slots[arg];
+                if(res > 0 && !job.failed) {
+                    slot.done += res;
+                    job.total_read += res;
+                    if(slot.done < slot.len) {
+                        backlog.push_back({j, type, arg});
+                        return;
+                    }
+                }
+                job.reads_out--;
+                if(res < 0) job.failed = true;
+                if(job.failed) {
+                    free_slots.push_back(arg);
+                    check_done(j);
+                    return;
+                }
+
+                if(res == 0) {
+                    uint64_t pos = slot.chunk * chunk_size + slot.done;
+                    if(!job.eof || pos < job.eof_pos) job.eof_pos = pos;
+                    job.eof = true;
+                }
+                else if(slot.chunk + 1 >= job.read_limit) {
+                    //the file is longer than statx said
+                    job.read_limit = slot.chunk + 2;
+                    enqueue(j);
+                }
+                job.data_read += slot.done;
+
+                if(slot.done == 0) {
+                    free_slots.push_back(arg);
+                    check_done(j);
+                    return;
+                }
+                apply_keystream(slot.buf.begin(), slot.buf.begin() + slot.done, job.ks, slot.chunk * chunk_size, encrypt);
+                slot.len = slot.done;
+                slot.done = 0;
+                job.writes_out++;
+                backlog.push_back({j, OpType::write, arg});
+                check_done(j);
+                return;
+            }
+            case OpType::write: {
+                Slot& slot = slots[arg];
+                if(res > 0) {
+                    slot.done += res;
+                    if(slot.done < slot.len) {
+                        backlog.push_back({j, type, arg});
+                        return;
+                    }
+                }
+                else {
+                    job.failed = true;
+                }
+                job.writes_out--;
+                free_slots.push_back(arg);
+                check_done(j);
+                return;
+            }
+            default:
+                break;
+            }
+
+            if(res < 0) job.failed = true;
+            if(--job.pending == 0) advance(j, type);
+        };
+
+        while(draining ? in_flight > 0 : (next_job < jobs.size() || active || in_flight || !backlog.empty())) {
+            if(!draining) {
+                while(active < max_jobs && next_job < jobs.size()) {
+                    start(next_job++);
+                }
+
+                //hand free chunk buffers out to files in turns
+                while(!free_slots.empty() && !streaming.empty()) {
+                    uint32_t j = streaming.front();
+                    streaming.pop_front();
+                    Job& job = jobs[j];
+                    job.queued = false;
+                    if(job.eof || job.failed || job.next_chunk >= job.read_limit) continue;
+
+                    uint32_t s = free_slots.back();
+                    free_slots.pop_back();
+                    Slot& slot = slots[s];
+                    slot.buf.resize(chunk_size);
+                    slot.chunk = job.next_chunk++;
+                    slot.len = chunk_size;
+                    slot.done = 0;
+                    job.reads_out++;
+                    backlog.push_back({j, OpType::read, s});
+
+                    enqueue(j);
+                }
+
+                while(!backlog.empty() && in_flight < ring.entries()) {
+                    io_uring_sqe* sqe = ring.get_sqe();
+                    if(sqe == nullptr) break;
+                    prepare(sqe, backlog.front());
+                    backlog.pop_front();
+                    in_flight++;
+                }
+            }
+
+            if(in_flight == 0) continue;
+            int ret = ring.submit(1);
+            if(ret < 0 && ret != -EAGAIN && ret != -EBUSY) {
+                if(draining) {
+                    //batch keeps the buffers alive for the kernel
+                    std::cout << "Error! io_uring operations could not be finished!\n";
+                    break;
+                }
+                std::cout << "Error! io_uring submission failed, waiting for pending operations!\n";
+                draining = true;
+            }
+
+            while(io_uring_cqe* cqe = ring.peek_cqe()) {
+                uint64_t user_data = cqe->user_data;
+                int res = cqe->res;
+                ring.cqe_seen();
+                in_flight--;
+                complete(user_data, res);
+            }
+        }
+
+        if(!draining) return true;
+
+        //close what is left synchronously
+        for(const auto& op : backlog) {
+            if(op.type == OpType::close_in || op.type == OpType::close_out) {
+                close(static_cast<int>(op.arg));
+            }
+        }
+        for(auto& job : jobs) {
+            if(job.in_fd >= 0) close(job.in_fd);
+            if(job.out_fd >= 0) close(job.out_fd);
+            if(job.done) continue;
+
+            std::cout << "Error! file " << files[&job - jobs.data()] << " was not processed!\n";
+            if(job.temp_created) std::remove(job.write_name.c_str());
+        }
+        return false;
+    }
+
+#else
+
+    class Ring {
+    public:
+        bool init(unsigned) {
+            return false;
+        }
+    };
+
+    struct Batch {};
+
+    const unsigned queue_depth = 128;
+
+    bool process_files(Ring&, Batch&, const std::vector<std::string>&, const std::vector<std::string>&,
+                       const std::string&, bool, bool) {
+        return false;
+    }
+
+#endif
+};
@@ -5,6 +5,8 @@
 #include <fstream>
 #include <filesystem>
 #include "hsss_lib.hpp"
+#include "hsss_archive.hpp"
+#include "hsss_uring.hpp"
 #include "ArgParser.hpp"
 #include "Util.hpp"
 
@@ -15,16 +17,24 @@ constexpr auto args = ArgParser::make_args(
     Arg('t', "text", ArgParser::ArgType::extended),
     Arg('e', "encrypt", ArgParser::ArgType::extended, 1),
     Arg('d', "decrypt", ArgParser::ArgType::extended, 1),
-    Arg('r', "remove")
+    Arg('r', "remove"),
+    Arg('p', "pack", ArgParser::ArgType::extended),
+    Arg('u', "unpack", ArgParser::ArgType::extended),
+    Arg('i', "io-uring")
 );
 
 const char* help_msg = 
     "Hash Salt Shift by Suski encryption algorithm v1.0\n"
-    "Usage: hsss [-e|-d] (password) [(filenames)|-t (text)]\n\n"
+    "Usage: hsss [-e|-d] (password) [(filenames)|-t (text)]\n"
+    "       hsss -e (password) -p (archive) (filenames)\n"
+    "       hsss -d (password) -u (archive) [(member names)]\n\n"
     "Available options:\n"
     " -e --encrypt   encrypts and sets the password\n"
     " -d --decrypt   decrypts and sets the password\n"
     " -r --remove    removes processed files\n"
+    " -p --pack      encrypts all files into one archive\n"
+    " -u --unpack    decrypts given members of an archive, or all of them if none are given\n"
+    " -i --io-uring  processes many files at once using io_uring (Linux only)\n"
     " -t --text      processes text instead of files. For encyrption its plain text, for decryption it should be in hex.\n"
     " -h --help      shows this message\n"
     " -v --version   shows version\n\n"
@@ -73,14 +83,94 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    //we process files
-    for(auto filename : ap.unnamed_args()) {
-        std::ifstream file(filename, std::ios::in | std::ios::binary);
+    //we pack files into one archive
+    if(ap.value('p') != nullptr) {
+        if(!encrypt) {
+            std::cout << "Packing requires -e option!\n";
+            return 1;
+        }
+        if(!hsss::archive::pack(ap.unnamed_args(), ap.value('e'), ap.value('p'))) {
+            return 1;
+        }
+
+        if(ap.set('r')) {
+            for(auto filename : ap.unnamed_args()) {
+                std::remove(filename);
+            }
+        }
+
+        std::cout << ap.unnamed_args().size() << " files successfully packed to " << ap.value('p') << '\n';
+        return 0;
+    }
+
+    //we unpack members of an archive
+    if(ap.value('u') != nullptr) {
+        if(encrypt) {
+            std::cout << "Unpacking requires -d option!\n";
+            return 1;
+        }
+        std::ifstream file(ap.value('u'), std::ios::in | std::ios::binary);
         if(!file) {
-            std::cout << "Error! file " << filename << " cannot be opened for reading!\n";
-            continue;
+            std::cout << "Error! file " << ap.value('u') << " cannot be opened for reading!\n";
+            return 1;
         }
 
+        hsss::archive::Keystream ks;
+        std::vector<hsss::archive::Entry> entries;
+        if(!hsss::archive::read_index(file, ap.value('d'), ks, entries)) {
+            std::cout << "Error! file " << ap.value('u') << " is not a valid archive or the password is wrong!\n";
+            return 1;
+        }
+
+        //members to unpack, all if none are given
+        std::vector<std::string> names;
+        bool ok = true;
+        for(auto name : ap.unnamed_args()) {
+            names.push_back(hsss::archive::member_name(name));
+            if(std::none_of(entries.begin(), entries.end(), [&](const auto& e) { return e.name == names.back(); })) {
+                std::cout << "Error! member " << name << " not found in " << ap.value('u') << "!\n";
+                ok = false;
+            }
+        }
+
+        for(const auto& e : entries) {
+            if(!names.empty() && std::find(names.begin(), names.end(), e.name) == names.end())
+                continue;
+
+            if(!hsss::archive::valid_member_name(e.name)) {
+                std::cout << "Error! member " << e.name << " would be written outside of current directory!\n";
+                ok = false;
+                continue;
+            }
+            std::filesystem::path path(e.name);
+            if(path.has_parent_path()) {
+                std::error_code ec;
+                std::filesystem::create_directories(path.parent_path(), ec);
+            }
+
+            std::ofstream ofile(path, std::ios::out | std::ios::binary);
+            if(!ofile) {
+                std::cout << "Error! file " << e.name << " could not be opened or created for write!\n";
+                ok = false;
+                continue;
+            }
+            if(!hsss::archive::extract(file, ks, e, ofile)) {
+                std::cout << "Error! member " << e.name << " is truncated!\n";
+                ok = false;
+                continue;
+            }
+            std::cout << "File " << e.name << " successfully unpacked\n";
+        }
+
+        //keep the archive if anything could not be unpacked
+        if(ap.set('r') && names.empty() && ok) {
+            file.close();
+            std::remove(ap.value('u'));
+        }
+        return ok ? 0 : 1;
+    }
+
+    auto output_name = [&](const char* filename) {
         std::string ofilename(filename);
         if(encrypt) {
             ofilename += ".hsss";
@@ -100,6 +190,38 @@ int main(int argc, char* argv[]) {
                     ofilename = filename;
             }
         }
+        return ofilename;
+    };
+
+    //we process files in batches
+    if(ap.set('i')) {
+        //declared first, so it outlives the ring
+        hsss::uring::Batch batch;
+        hsss::uring::Ring ring;
+        if(ring.init(hsss::uring::queue_depth)) {
+            std::vector<std::string> files;
+            std::vector<std::string> ofilenames;
+            for(auto filename : ap.unnamed_args()) {
+                files.push_back(filename);
+                ofilenames.push_back(output_name(filename));
+            }
+            if(!hsss::uring::process_files(ring, batch, files, ofilenames, ap.value(encrypt ? 'e' : 'd'), encrypt, ap.set('r'))) {
+                return 1;
+            }
+            return 0;
+        }
+        std::cout << "io_uring is not available, falling back to regular file access\n";
+    }
+
+    //we process files
+    for(auto filename : ap.unnamed_args()) {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        if(!file) {
+            std::cout << "Error! file " << filename << " cannot be opened for reading!\n";
+            continue;
+        }
+
+        std::string ofilename = output_name(filename);
         
         std::ofstream ofile(ofilename, std::ios::out | std::ios::binary);
         if(!ofile) {